@@ -67,6 +67,9 @@ typedef struct bpe
   unsigned char replacement_symbol;
   unsigned char replacement_symbols[BPE_MAX_ITERATIONS]; /* DECODE: which replacement symbol has been used in the iteration*/
   unsigned short replacement_pairs[BPE_MAX_ITERATIONS];  /* DECODE: which replacement pair has been used in the iteration*/
+  unsigned int replacement_count;                        /* Number of pairs replaced in the last iteration (bytes saved) */
+
+  unsigned int symbol_expansions[BPE_NUM_CHARS]; /* DECODE: additional bytes a symbol expands to (0 for a plain character) */
 
 } bpe;
 
@@ -161,12 +164,15 @@ BPE_API BPE_INLINE void bpe_most_frequent_pair(bpe *model)
     a = (unsigned char)model->text[i];
     b = (unsigned char)model->text[i + 1];
 
-    used_chars[a] = 1;
-    used_chars[b] = 1;
-
     count[bpe_convert_pair_to_id(a, b)]++;
   }
 
+  /* Every character counts as used, including the last one of an uneven text */
+  for (i = 0; i < model->text_length; ++i)
+  {
+    used_chars[(unsigned char)model->text[i]] = 1;
+  }
+
   /* Find the most frequent pair */
   model->most_frequent_pair_count = 0;
 
@@ -188,13 +194,7 @@ BPE_API BPE_INLINE void bpe_most_frequent_pair(bpe *model)
     }
   }
 
-  /* If no unused character is found, assign a new extended symbol */
-  if (replacement_symbol == 0)
-  {
-    replacement_symbol = (unsigned char)(256 + model->iteration_count);
-  }
-
-  if (model->iteration_count < BPE_MAX_ITERATIONS)
+  if (model->iteration_count < BPE_MAX_ITERATIONS && replacement_symbol != 0)
   {
     model->replacement_symbol = replacement_symbol;
     model->replacement_symbols[model->iteration_count] = replacement_symbol;
@@ -202,39 +202,44 @@ BPE_API BPE_INLINE void bpe_most_frequent_pair(bpe *model)
   }
   else
   {
-    /* If we run out of replacement space, we stop further encoding */
+    /* If we run out of replacement space or unused characters, we stop further encoding */
     model->most_frequent_pair_count = 0;
   }
 }
 
-BPE_API BPE_INLINE void bpe_replace_pair(bpe *model)
+/* Replaces every non overlapping occurrence of pair from left to right in place.
+   Bounded by length and not by '\0' so that binary text can be encoded. Returns the new length. */
+BPE_API BPE_INLINE unsigned int bpe_replace_pair_in(char *text, unsigned int length, unsigned short pair, unsigned char replacement_symbol)
 {
-  int i = 0;
-  int j = 0;
-  unsigned int replacements = 0;
-
-  while (model->text[i] != '\0')
-  {
-    unsigned char first;
-    unsigned char second;
+  unsigned char first, second;
+  unsigned int i = 0;
+  unsigned int j = 0;
 
-    bpe_convert_id_to_pair(model->most_frequent_pair, &first, &second);
+  bpe_convert_id_to_pair(pair, &first, &second);
 
-    /* If we find the pair, replace it with the new symbol */
-    if (model->text[i] == (char)first && model->text[i + 1] == (char)second)
+  while (i < length)
+  {
+    if (i + 1 < length && (unsigned char)text[i] == first && (unsigned char)text[i + 1] == second)
     {
-      model->text[j++] = (char)model->replacement_symbol;
+      text[j++] = (char)replacement_symbol;
       i += 2;
-      replacements++;
     }
     else
     {
-      model->text[j++] = model->text[i++];
+      text[j++] = text[i++];
     }
   }
 
-  model->text[j] = '\0';
-  model->text_length -= replacements;
+  return (j);
+}
+
+BPE_API BPE_INLINE void bpe_replace_pair(bpe *model)
+{
+  unsigned int length = bpe_replace_pair_in(model->text, model->text_length, model->most_frequent_pair, model->replacement_symbol);
+
+  model->text[length] = '\0';
+  model->replacement_count = model->text_length - length;
+  model->text_length = length;
 }
 
 BPE_API BPE_INLINE bpe_bool bpe_forward(bpe *model)
@@ -250,15 +255,45 @@ BPE_API BPE_INLINE bpe_bool bpe_forward(bpe *model)
   /* (2) Replace the pair with a new symbol */
   bpe_replace_pair(model);
 
+  /* (3) The new symbol expands to both symbols of the pair. A replacement symbol
+         can be reused once it vanished from the text so it is always overwritten */
+  {
+    unsigned char first, second;
+    bpe_convert_id_to_pair(model->most_frequent_pair, &first, &second);
+    model->symbol_expansions[model->replacement_symbol] = 1 + model->symbol_expansions[first] + model->symbol_expansions[second];
+  }
+
   model->iteration_count++;
 
   return (1);
 }
 
+/* Sums the expansion table over the encoded text. Shared by all decoded size functions. */
+BPE_API BPE_INLINE unsigned int bpe_expanded_size(const unsigned int expansions[BPE_NUM_CHARS], const char *encoded, unsigned int length)
+{
+  unsigned int size = length;
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    size += expansions[(unsigned char)encoded[i]];
+  }
+
+  return (size);
+}
+
+/* Returns the length the encoded text will have after bpe_decode without decoding it.
+   Use it to size the decode buffer exactly once (+1 for the terminating '\0'). */
+BPE_API BPE_INLINE unsigned int bpe_decoded_size(const bpe *model, const char *encoded, unsigned int length)
+{
+  return (bpe_expanded_size(model->symbol_expansions, encoded, length));
+}
+
+/* Decodes model->text in place which must hold bpe_decoded_size + 1 bytes */
 BPE_API BPE_INLINE void bpe_decode(bpe *model)
 {
-  int i, j, k;
-  char temp[BPE_MAX_SYMBOLS]; /* Buffer to hold expanding text */
+  int i;
+  unsigned int j, k;
 
   /* Start with the compressed text */
   unsigned int text_length = model->text_length;
@@ -269,35 +304,927 @@ BPE_API BPE_INLINE void bpe_decode(bpe *model)
     unsigned short replacement_pair = model->replacement_pairs[i]; /* Retrieve original pair */
     unsigned char replacement_symbol = model->replacement_symbols[i];
     unsigned char first, second;
+    unsigned int expanded_length = text_length;
     bpe_convert_id_to_pair(replacement_pair, &first, &second);
 
-    j = 0;
-    for (k = 0; k < (int)text_length; k++)
+    for (k = 0; k < text_length; k++)
     {
       if ((unsigned char)model->text[k] == replacement_symbol)
+      {
+        expanded_length++;
+      }
+    }
+
+    /* Expand back to front so that no unread symbol is overwritten */
+    j = expanded_length;
+    for (k = text_length; k > 0; k--)
+    {
+      if ((unsigned char)model->text[k - 1] == replacement_symbol)
       {
         /* Replace with the original pair */
-        temp[j++] = (char)first;
-        temp[j++] = (char)second;
+        model->text[--j] = (char)second;
+        model->text[--j] = (char)first;
       }
       else
       {
-        temp[j++] = model->text[k];
+        model->text[--j] = model->text[k - 1];
       }
     }
 
-    /* Copy back expanded text */
-    text_length = (unsigned int)j;
-    for (j = 0; j < (int)text_length; j++)
-    {
-      model->text[j] = temp[j];
-    }
+    text_length = expanded_length;
     model->text[text_length] = '\0';
   }
 
   model->text_length = text_length;
 }
 
+/* #############################################################################
+ * # DICTIONARY
+ * #############################################################################
+ *
+ * Short messages rarely contain a pair twice so bpe_forward cannot compress them.
+ * Instead a dictionary is trained once on many sample messages and shared by the
+ * encoder and decoder. Messages are then encoded without any per message training
+ * and a frame only carries the id of the dictionary it was encoded with.
+ */
+#define BPE_FRAME_HEADER_SIZE 2 /* Dictionary id (little endian) */
+#define BPE_FRAME_RAW 0         /* Dictionary id of a frame that holds the unencoded message */
+
+typedef struct bpe_dictionary
+{
+  unsigned short id; /* Written to every frame, must not be BPE_FRAME_RAW */
+
+  unsigned int merge_count;
+  unsigned char replacement_symbols[BPE_MAX_ITERATIONS]; /* Merges in the order they are applied */
+  unsigned short replacement_pairs[BPE_MAX_ITERATIONS];
+
+  unsigned short symbol_pairs[BPE_NUM_CHARS];      /* Pair a replacement symbol stands for */
+  unsigned int symbol_expansions[BPE_NUM_CHARS];   /* Additional bytes a symbol expands to (0 for a plain character) */
+  unsigned char reserved_symbols[BPE_NUM_CHARS];   /* 1 if the character is used as a replacement symbol */
+
+} bpe_dictionary;
+
+/* Trains the dictionary on sample_count separate samples. Pairs are never formed
+   across two samples. The samples are modified in place (and their lengths updated)
+   while training so pass copies if they are still needed afterwards.
+   Returns 0 without training if id is BPE_FRAME_RAW. */
+BPE_API BPE_INLINE bpe_bool bpe_dictionary_train(bpe_dictionary *dict, unsigned short id, char **samples, unsigned int *sample_lengths, unsigned int sample_count)
+{
+  unsigned int count[BPE_MAX_SYMBOLS];
+  unsigned char used_chars[BPE_NUM_CHARS] = {0};
+  unsigned int i, j;
+
+  dict->id = BPE_FRAME_RAW;
+  dict->merge_count = 0;
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    dict->symbol_pairs[i] = 0;
+    dict->symbol_expansions[i] = 0;
+    dict->reserved_symbols[i] = 0;
+  }
+
+  /* Frames of this dictionary would be decoded as raw text */
+  if (id == BPE_FRAME_RAW)
+  {
+    return (0);
+  }
+
+  dict->id = id;
+
+  /* Replacement symbols must never appear in the samples */
+  for (i = 0; i < sample_count; ++i)
+  {
+    for (j = 0; j < sample_lengths[i]; ++j)
+    {
+      used_chars[(unsigned char)samples[i][j]] = 1;
+    }
+  }
+
+  while (dict->merge_count < BPE_MAX_ITERATIONS)
+  {
+    unsigned short most_frequent_pair = 0;
+    unsigned int most_frequent_pair_count = 0;
+    unsigned char replacement_symbol = 0;
+    unsigned char first, second;
+
+    for (i = 0; i < BPE_MAX_SYMBOLS; ++i)
+    {
+      count[i] = 0;
+    }
+
+    /* (1) Count the pairs within each sample */
+    for (i = 0; i < sample_count; ++i)
+    {
+      for (j = 0; j + 1 < sample_lengths[i]; ++j)
+      {
+        count[bpe_convert_pair_to_id((unsigned char)samples[i][j], (unsigned char)samples[i][j + 1])]++;
+      }
+    }
+
+    for (i = 0; i < BPE_MAX_SYMBOLS; ++i)
+    {
+      if (count[i] > most_frequent_pair_count)
+      {
+        most_frequent_pair_count = count[i];
+        most_frequent_pair = (unsigned short)i;
+      }
+    }
+
+    if (most_frequent_pair_count <= 1)
+    {
+      break;
+    }
+
+    /* (2) Find a character that is neither in the samples nor already a symbol */
+    for (i = 128; i < 255; ++i)
+    {
+      if (!used_chars[i] && !dict->reserved_symbols[i])
+      {
+        replacement_symbol = (unsigned char)i;
+      }
+    }
+
+    if (replacement_symbol == 0)
+    {
+      break;
+    }
+
+    /* (3) Replace the pair in every sample */
+    for (i = 0; i < sample_count; ++i)
+    {
+      sample_lengths[i] = bpe_replace_pair_in(samples[i], sample_lengths[i], most_frequent_pair, replacement_symbol);
+    }
+
+    bpe_convert_id_to_pair(most_frequent_pair, &first, &second);
+
+    dict->replacement_symbols[dict->merge_count] = replacement_symbol;
+    dict->replacement_pairs[dict->merge_count] = most_frequent_pair;
+    dict->symbol_pairs[replacement_symbol] = most_frequent_pair;
+    dict->symbol_expansions[replacement_symbol] = 1 + dict->symbol_expansions[first] + dict->symbol_expansions[second];
+    dict->reserved_symbols[replacement_symbol] = 1;
+    dict->merge_count++;
+  }
+
+  return (1);
+}
+
+/* Encodes the text in place with the merges of the dictionary.
+   Returns 0 and leaves the text untouched if it contains a character the dictionary
+   uses as a replacement symbol since it could not be decoded unambiguously. */
+BPE_API BPE_INLINE bpe_bool bpe_dictionary_encode(const bpe_dictionary *dict, char *text, unsigned int *text_length)
+{
+  unsigned int length = *text_length;
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    if (dict->reserved_symbols[(unsigned char)text[i]])
+    {
+      return (0);
+    }
+  }
+
+  for (i = 0; i < dict->merge_count; ++i)
+  {
+    length = bpe_replace_pair_in(text, length, dict->replacement_pairs[i], dict->replacement_symbols[i]);
+  }
+
+  *text_length = length;
+
+  return (1);
+}
+
+BPE_API BPE_INLINE unsigned int bpe_dictionary_decoded_size(const bpe_dictionary *dict, const char *encoded, unsigned int length)
+{
+  return (bpe_expanded_size(dict->symbol_expansions, encoded, length));
+}
+
+/* Decodes into text which must hold bpe_dictionary_decoded_size bytes (no '\0' is written).
+   Returns the decoded length. */
+BPE_API BPE_INLINE unsigned int bpe_dictionary_decode(const bpe_dictionary *dict, const char *encoded, unsigned int length, char *text)
+{
+  unsigned char stack[BPE_NUM_CHARS]; /* Symbols are unique so the expansion depth is bounded */
+  unsigned int i;
+  unsigned int j = 0;
+
+  for (i = 0; i < length; ++i)
+  {
+    unsigned int top = 0;
+    stack[top++] = (unsigned char)encoded[i];
+
+    while (top > 0)
+    {
+      unsigned char symbol = stack[--top];
+
+      if (dict->reserved_symbols[symbol])
+      {
+        unsigned char first, second;
+        bpe_convert_id_to_pair(dict->symbol_pairs[symbol], &first, &second);
+
+        /* Push second first so that first is expanded first */
+        stack[top++] = second;
+        stack[top++] = first;
+      }
+      else
+      {
+        text[j++] = (char)symbol;
+      }
+    }
+  }
+
+  return (j);
+}
+
+BPE_API BPE_INLINE unsigned short bpe_frame_dictionary_id(const char *frame)
+{
+  return (unsigned short)((unsigned char)frame[0] | ((unsigned char)frame[1] << 8));
+}
+
+/* Writes the frame for text into frame which must hold length + BPE_FRAME_HEADER_SIZE bytes.
+   Falls back to a BPE_FRAME_RAW frame if the text cannot be encoded with the dictionary
+   or the dictionary id is BPE_FRAME_RAW. Returns the frame length. */
+BPE_API BPE_INLINE unsigned int bpe_frame_encode(const bpe_dictionary *dict, const char *text, unsigned int length, char *frame)
+{
+  char *payload = frame + BPE_FRAME_HEADER_SIZE;
+  unsigned short id = dict->id;
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    payload[i] = text[i];
+  }
+
+  if (id == BPE_FRAME_RAW || !bpe_dictionary_encode(dict, payload, &length))
+  {
+    id = BPE_FRAME_RAW;
+  }
+
+  frame[0] = (char)(id & 0xFF);
+  frame[1] = (char)(id >> 8);
+
+  return (length + BPE_FRAME_HEADER_SIZE);
+}
+
+/* Decodes the frame into text which must hold bpe_dictionary_decoded_size of the payload bytes
+   and stores the decoded length in text_length.
+   Returns 0 if the frame is truncated or was encoded with a different dictionary. */
+BPE_API BPE_INLINE bpe_bool bpe_frame_decode(const bpe_dictionary *dict, const char *frame, unsigned int frame_length, char *text, unsigned int *text_length)
+{
+  const char *payload = frame + BPE_FRAME_HEADER_SIZE;
+  unsigned int length = frame_length - BPE_FRAME_HEADER_SIZE;
+  unsigned short id;
+  unsigned int i;
+
+  if (frame_length < BPE_FRAME_HEADER_SIZE)
+  {
+    return (0);
+  }
+
+  id = bpe_frame_dictionary_id(frame);
+
+  if (id == BPE_FRAME_RAW)
+  {
+    for (i = 0; i < length; ++i)
+    {
+      text[i] = payload[i];
+    }
+    *text_length = length;
+    return (1);
+  }
+
+  if (id != dict->id)
+  {
+    return (0);
+  }
+
+  *text_length = bpe_dictionary_decode(dict, payload, length, text);
+
+  return (1);
+}
+
+/* #############################################################################
+ * # STATIC DICTIONARY
+ * #############################################################################
+ *
+ * A dictionary flattened into lookup tables. tools/bpe_generate.c emits it as a
+ * static const C89 header so a fixed dictionary needs no training, loading or
+ * table construction at runtime and the compiler can fold the table lookups.
+ */
+typedef struct bpe_static_dictionary
+{
+  unsigned short id;
+  unsigned int merge_count;
+
+  unsigned short pair_ranks[BPE_MAX_SYMBOLS];      /* ENCODE: rank + 1 of the merge for a pair, 0 if the pair is never merged */
+  unsigned short rank_pairs[BPE_NUM_CHARS];        /* ENCODE: pair merged at rank */
+  unsigned char rank_symbols[BPE_NUM_CHARS];       /* ENCODE: replacement symbol of rank */
+  unsigned int symbol_expansions[BPE_NUM_CHARS];   /* DECODE: additional bytes a symbol expands to (0 for a plain character) */
+  unsigned int symbol_offsets[BPE_NUM_CHARS];      /* DECODE: offset of the expansion of a symbol in expansion_data */
+  const char *expansion_data;                      /* DECODE: fully expanded text of every symbol */
+
+} bpe_static_dictionary;
+
+/* Flattens dict into out. expansion_data receives the expanded text of every symbol
+   and the number of bytes used is stored in expansion_data_length (0 for a dictionary without merges).
+   Returns 0 if the capacity is too small. */
+BPE_API BPE_INLINE bpe_bool bpe_static_dictionary_build(const bpe_dictionary *dict, bpe_static_dictionary *out, char *expansion_data, unsigned int expansion_data_capacity, unsigned int *expansion_data_length)
+{
+  unsigned int used = 0;
+  unsigned int i;
+
+  out->id = dict->id;
+  out->merge_count = dict->merge_count;
+  out->expansion_data = expansion_data;
+
+  for (i = 0; i < BPE_MAX_SYMBOLS; ++i)
+  {
+    out->pair_ranks[i] = 0;
+  }
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    out->rank_pairs[i] = 0;
+    out->rank_symbols[i] = 0;
+    out->symbol_expansions[i] = dict->symbol_expansions[i];
+    out->symbol_offsets[i] = 0;
+  }
+
+  for (i = 0; i < dict->merge_count; ++i)
+  {
+    unsigned char symbol = dict->replacement_symbols[i];
+    unsigned int size = dict->symbol_expansions[symbol] + 1;
+
+    if (size > expansion_data_capacity - used)
+    {
+      *expansion_data_length = 0;
+      return (0);
+    }
+
+    out->pair_ranks[dict->replacement_pairs[i]] = (unsigned short)(i + 1);
+    out->rank_pairs[i] = dict->replacement_pairs[i];
+    out->rank_symbols[i] = symbol;
+    out->symbol_offsets[symbol] = used;
+
+    used += bpe_dictionary_decode(dict, (const char *)&symbol, 1, expansion_data + used);
+  }
+
+  *expansion_data_length = used;
+
+  return (1);
+}
+
+/* Encodes the text in place. Produces the same output as bpe_dictionary_encode but
+   only runs the merges whose pair actually occurs in the text.
+   Returns 0 and leaves the text untouched if it contains a replacement symbol. */
+BPE_API BPE_INLINE bpe_bool bpe_static_encode(const bpe_static_dictionary *dict, char *text, unsigned int *text_length)
+{
+  unsigned int length = *text_length;
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    if (dict->symbol_expansions[(unsigned char)text[i]])
+    {
+      return (0);
+    }
+  }
+
+  for (;;)
+  {
+    /* A merge only creates pairs of higher rank, so always merging the lowest rank
+       present is equivalent to running all merges in order */
+    unsigned int rank = 0;
+
+    for (i = 0; i + 1 < length; ++i)
+    {
+      unsigned int r = dict->pair_ranks[bpe_convert_pair_to_id((unsigned char)text[i], (unsigned char)text[i + 1])];
+
+      if (r && (!rank || r < rank))
+      {
+        rank = r;
+      }
+    }
+
+    if (!rank)
+    {
+      break;
+    }
+
+    length = bpe_replace_pair_in(text, length, dict->rank_pairs[rank - 1], dict->rank_symbols[rank - 1]);
+  }
+
+  *text_length = length;
+
+  return (1);
+}
+
+BPE_API BPE_INLINE unsigned int bpe_static_decoded_size(const bpe_static_dictionary *dict, const char *encoded, unsigned int length)
+{
+  return (bpe_expanded_size(dict->symbol_expansions, encoded, length));
+}
+
+/* Decodes into text which must hold bpe_static_decoded_size bytes (no '\0' is written).
+   Returns the decoded length. */
+BPE_API BPE_INLINE unsigned int bpe_static_decode(const bpe_static_dictionary *dict, const char *encoded, unsigned int length, char *text)
+{
+  unsigned int i, k;
+  unsigned int j = 0;
+
+  for (i = 0; i < length; ++i)
+  {
+    unsigned char symbol = (unsigned char)encoded[i];
+    unsigned int expansion = dict->symbol_expansions[symbol];
+
+    if (expansion)
+    {
+      const char *src = dict->expansion_data + dict->symbol_offsets[symbol];
+
+      for (k = 0; k <= expansion; ++k)
+      {
+        text[j++] = src[k];
+      }
+    }
+    else
+    {
+      text[j++] = (char)symbol;
+    }
+  }
+
+  return (j);
+}
+
+/* #############################################################################
+ * # ENTROPY CODING
+ * #############################################################################
+ *
+ * The symbols left after merging are still stored as one byte each although
+ * their frequencies are highly skewed. An optional second stage encodes them with
+ * a length limited canonical huffman code built from the training frequencies.
+ * The symbols are split into BPE_HUFFMAN_STREAMS independent bit streams that are
+ * decoded interleaved with a single table lookup per symbol.
+ *
+ * Encoded layout (little endian):
+ *   [symbol count (4)] [size of streams 0..2 (4 each)] [stream 0] [stream 1] [stream 2] [stream 3]
+ */
+#define BPE_HUFFMAN_MAX_CODE_LENGTH 11
+#define BPE_HUFFMAN_TABLE_SIZE (1 << BPE_HUFFMAN_MAX_CODE_LENGTH)
+#define BPE_HUFFMAN_STREAMS 4 /* The decode loop is unrolled for exactly four streams */
+#define BPE_HUFFMAN_HEADER_SIZE (4 * BPE_HUFFMAN_STREAMS)
+
+/* Worst case size of bpe_huffman_encode for length symbols */
+#define BPE_HUFFMAN_BOUND(length) (BPE_HUFFMAN_HEADER_SIZE + ((length) * BPE_HUFFMAN_MAX_CODE_LENGTH + 7) / 8 + BPE_HUFFMAN_STREAMS)
+
+typedef struct bpe_huffman
+{
+  unsigned char code_lengths[BPE_NUM_CHARS];             /* Enough to rebuild the code with bpe_huffman_build_codes */
+  unsigned short codes[BPE_NUM_CHARS];                   /* ENCODE: canonical code, bit reversed since streams are written LSB first */
+  unsigned short decode_table[BPE_HUFFMAN_TABLE_SIZE];   /* DECODE: symbol | code length << 8 for the next BPE_HUFFMAN_MAX_CODE_LENGTH bits */
+
+} bpe_huffman;
+
+typedef struct bpe_huffman_stream
+{
+  const unsigned char *data;
+  const unsigned char *end;
+  unsigned long bits;
+  unsigned int bit_count;
+  unsigned int padding_bits; /* Zero bits appended past end, decoding into them means truncated input */
+
+} bpe_huffman_stream;
+
+/* Adds the symbol frequencies of text to frequencies. After bpe_dictionary_train the
+   samples hold their final symbols so they can be counted directly. */
+BPE_API BPE_INLINE void bpe_huffman_count(unsigned long frequencies[BPE_NUM_CHARS], const char *text, unsigned int length)
+{
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    frequencies[(unsigned char)text[i]]++;
+  }
+}
+
+BPE_API BPE_INLINE void bpe_huffman_write_u32(char *out, unsigned int value)
+{
+  out[0] = (char)(value & 0xFF);
+  out[1] = (char)((value >> 8) & 0xFF);
+  out[2] = (char)((value >> 16) & 0xFF);
+  out[3] = (char)((value >> 24) & 0xFF);
+}
+
+BPE_API BPE_INLINE unsigned int bpe_huffman_read_u32(const char *in)
+{
+  return ((unsigned int)(unsigned char)in[0]) |
+         ((unsigned int)(unsigned char)in[1] << 8) |
+         ((unsigned int)(unsigned char)in[2] << 16) |
+         ((unsigned int)(unsigned char)in[3] << 24);
+}
+
+/* Builds the codes and the decode table from code_lengths.
+   Returns 0 if the code lengths do not form a valid prefix code. */
+BPE_API BPE_INLINE bpe_bool bpe_huffman_build_codes(bpe_huffman *huffman)
+{
+  unsigned int length_counts[BPE_HUFFMAN_MAX_CODE_LENGTH + 1] = {0};
+  unsigned int next_code[BPE_HUFFMAN_MAX_CODE_LENGTH + 1];
+  unsigned int kraft = 0;
+  unsigned int code = 0;
+  unsigned int i, j;
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    if (huffman->code_lengths[i] > BPE_HUFFMAN_MAX_CODE_LENGTH)
+    {
+      return (0);
+    }
+    length_counts[huffman->code_lengths[i]]++;
+  }
+
+  /* Symbols without a code do not take part in the canonical ordering */
+  length_counts[0] = 0;
+
+  for (i = 1; i <= BPE_HUFFMAN_MAX_CODE_LENGTH; ++i)
+  {
+    kraft += length_counts[i] << (BPE_HUFFMAN_MAX_CODE_LENGTH - i);
+    code = (code + length_counts[i - 1]) << 1;
+    next_code[i] = code;
+  }
+
+  if (kraft > BPE_HUFFMAN_TABLE_SIZE)
+  {
+    return (0);
+  }
+
+  for (i = 0; i < BPE_HUFFMAN_TABLE_SIZE; ++i)
+  {
+    huffman->decode_table[i] = 0;
+  }
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    unsigned int length = huffman->code_lengths[i];
+    unsigned int reversed = 0;
+
+    huffman->codes[i] = 0;
+
+    if (length == 0)
+    {
+      continue;
+    }
+
+    code = next_code[length]++;
+
+    for (j = 0; j < length; ++j)
+    {
+      reversed = (reversed << 1) | ((code >> j) & 1);
+    }
+
+    huffman->codes[i] = (unsigned short)reversed;
+
+    for (j = reversed; j < BPE_HUFFMAN_TABLE_SIZE; j += 1u << length)
+    {
+      huffman->decode_table[j] = (unsigned short)(i | (length << 8));
+    }
+  }
+
+  return (1);
+}
+
+/* Builds a code from the symbol frequencies (e.g. counted on the training samples).
+   Every symbol gets a code, even ones that never occurred in training. */
+BPE_API BPE_INLINE void bpe_huffman_build(bpe_huffman *huffman, const unsigned long frequencies[BPE_NUM_CHARS])
+{
+  unsigned long keys[BPE_NUM_CHARS];
+  unsigned char symbols[BPE_NUM_CHARS];
+  unsigned int length_counts[32] = {0};
+  unsigned long kraft = 0;
+  int root, leaf, next, available, used, depth;
+  int i, j;
+  int n = BPE_NUM_CHARS;
+
+  /* (1) Sort the symbols by frequency (ascending), +1 so that every symbol is encodable */
+  for (i = 0; i < n; ++i)
+  {
+    unsigned long key = frequencies[i] + 1;
+
+    for (j = i; j > 0 && keys[j - 1] > key; --j)
+    {
+      keys[j] = keys[j - 1];
+      symbols[j] = symbols[j - 1];
+    }
+
+    keys[j] = key;
+    symbols[j] = (unsigned char)i;
+  }
+
+  /* (2) In place minimum redundancy code lengths (Moffat & Katajainen) */
+  keys[0] += keys[1];
+  root = 0;
+  leaf = 2;
+
+  for (next = 1; next < n - 1; ++next)
+  {
+    if (leaf >= n || keys[root] < keys[leaf])
+    {
+      keys[next] = keys[root];
+      keys[root++] = (unsigned long)next;
+    }
+    else
+    {
+      keys[next] = keys[leaf++];
+    }
+
+    if (leaf >= n || (root < next && keys[root] < keys[leaf]))
+    {
+      keys[next] += keys[root];
+      keys[root++] = (unsigned long)next;
+    }
+    else
+    {
+      keys[next] += keys[leaf++];
+    }
+  }
+
+  keys[n - 2] = 0;
+
+  for (next = n - 3; next >= 0; --next)
+  {
+    keys[next] = keys[keys[next]] + 1;
+  }
+
+  available = 1;
+  used = 0;
+  depth = 0;
+  root = n - 2;
+  next = n - 1;
+
+  while (available > 0)
+  {
+    while (root >= 0 && (int)keys[root] == depth)
+    {
+      used++;
+      root--;
+    }
+
+    while (available > used)
+    {
+      keys[next--] = (unsigned long)depth;
+      available--;
+    }
+
+    available = 2 * used;
+    depth++;
+    used = 0;
+  }
+
+  /* (3) Limit the code lengths and repair the kraft sum */
+  for (i = 0; i < n; ++i)
+  {
+    length_counts[keys[i] > BPE_HUFFMAN_MAX_CODE_LENGTH ? BPE_HUFFMAN_MAX_CODE_LENGTH : keys[i]]++;
+  }
+
+  for (i = BPE_HUFFMAN_MAX_CODE_LENGTH; i > 0; --i)
+  {
+    kraft += (unsigned long)length_counts[i] << (BPE_HUFFMAN_MAX_CODE_LENGTH - i);
+  }
+
+  while (kraft > BPE_HUFFMAN_TABLE_SIZE)
+  {
+    length_counts[BPE_HUFFMAN_MAX_CODE_LENGTH]--;
+
+    for (i = BPE_HUFFMAN_MAX_CODE_LENGTH - 1; i > 0; --i)
+    {
+      if (length_counts[i])
+      {
+        length_counts[i]--;
+        length_counts[i + 1] += 2;
+        break;
+      }
+    }
+
+    kraft--;
+  }
+
+  /* (4) The least frequent symbols get the longest codes */
+  j = 0;
+  for (i = BPE_HUFFMAN_MAX_CODE_LENGTH; i > 0; --i)
+  {
+    unsigned int k;
+
+    for (k = 0; k < length_counts[i]; ++k)
+    {
+      huffman->code_lengths[symbols[j++]] = (unsigned char)i;
+    }
+  }
+
+  bpe_huffman_build_codes(huffman);
+}
+
+BPE_API BPE_INLINE unsigned int bpe_huffman_stream_count(unsigned int length, unsigned int stream)
+{
+  unsigned int segment = (length + BPE_HUFFMAN_STREAMS - 1) / BPE_HUFFMAN_STREAMS;
+  unsigned int start = segment * stream;
+
+  if (start >= length)
+  {
+    return (0);
+  }
+
+  return (length - start < segment ? length - start : segment);
+}
+
+/* Encodes text into out which must hold BPE_HUFFMAN_BOUND(length) bytes.
+   Returns the encoded size or 0 if the text contains a symbol without a code. */
+BPE_API BPE_INLINE unsigned int bpe_huffman_encode(const bpe_huffman *huffman, const char *text, unsigned int length, char *out)
+{
+  unsigned int segment = (length + BPE_HUFFMAN_STREAMS - 1) / BPE_HUFFMAN_STREAMS;
+  unsigned int size = BPE_HUFFMAN_HEADER_SIZE;
+  unsigned int stream, i;
+
+  bpe_huffman_write_u32(out, length);
+
+  for (stream = 0; stream < BPE_HUFFMAN_STREAMS; ++stream)
+  {
+    const char *symbols = text + segment * stream;
+    unsigned int count = bpe_huffman_stream_count(length, stream);
+    unsigned int stream_start = size;
+    unsigned long bits = 0;
+    unsigned int bit_count = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+      unsigned char symbol = (unsigned char)symbols[i];
+
+      if (huffman->code_lengths[symbol] == 0)
+      {
+        return (0);
+      }
+
+      bits |= (unsigned long)huffman->codes[symbol] << bit_count;
+      bit_count += huffman->code_lengths[symbol];
+
+      while (bit_count >= 8)
+      {
+        out[size++] = (char)(bits & 0xFF);
+        bits >>= 8;
+        bit_count -= 8;
+      }
+    }
+
+    if (bit_count > 0)
+    {
+      out[size++] = (char)(bits & 0xFF);
+    }
+
+    if (stream < BPE_HUFFMAN_STREAMS - 1)
+    {
+      bpe_huffman_write_u32(out + 4 + 4 * stream, size - stream_start);
+    }
+  }
+
+  return (size);
+}
+
+/* Number of symbols bpe_huffman_decode will write */
+BPE_API BPE_INLINE unsigned int bpe_huffman_decoded_size(const char *encoded)
+{
+  return (bpe_huffman_read_u32(encoded));
+}
+
+BPE_API BPE_INLINE void bpe_huffman_refill(bpe_huffman_stream *stream)
+{
+  /* Keeps at least 24 bits so two symbols can be decoded per refill */
+  if (stream->end - stream->data >= 4)
+  {
+    /* Fast path: load four bytes at once and only advance by the whole bytes that fit */
+    const unsigned char *data = stream->data;
+    unsigned long word = (unsigned long)data[0] | ((unsigned long)data[1] << 8) | ((unsigned long)data[2] << 16) | ((unsigned long)data[3] << 24);
+    unsigned int bytes = (31 - stream->bit_count) >> 3;
+
+    stream->bits |= (word << stream->bit_count) & 0xFFFFFFFFUL;
+    stream->data += bytes;
+    stream->bit_count += bytes * 8;
+    return;
+  }
+
+  /* Reading past the end yields zeros which are counted so bpe_huffman_decode can reject them */
+  while (stream->bit_count <= 24)
+  {
+    if (stream->data < stream->end)
+    {
+      stream->bits |= (unsigned long)*stream->data++ << stream->bit_count;
+    }
+    else
+    {
+      stream->padding_bits += 8;
+    }
+    stream->bit_count += 8;
+  }
+}
+
+BPE_API BPE_INLINE char bpe_huffman_decode_symbol(const bpe_huffman *huffman, bpe_huffman_stream *stream)
+{
+  unsigned short entry = huffman->decode_table[stream->bits & (BPE_HUFFMAN_TABLE_SIZE - 1)];
+  unsigned int length = (unsigned int)(entry >> 8);
+
+  stream->bits >>= length;
+  stream->bit_count -= length;
+
+  return ((char)(entry & 0xFF));
+}
+
+/* Decodes into text which must hold bpe_huffman_decoded_size bytes and stores the number
+   of decoded symbols in text_length.
+   Returns 0 if the stream sizes are invalid or a stream holds fewer bits than it decoded (truncated input). */
+BPE_API BPE_INLINE bpe_bool bpe_huffman_decode(const bpe_huffman *huffman, const char *encoded, unsigned int encoded_length, char *text, unsigned int *text_length)
+{
+  bpe_huffman_stream streams[BPE_HUFFMAN_STREAMS];
+  char *out[BPE_HUFFMAN_STREAMS];
+  unsigned int counts[BPE_HUFFMAN_STREAMS];
+  const unsigned char *data = (const unsigned char *)encoded + BPE_HUFFMAN_HEADER_SIZE;
+  const unsigned char *end = (const unsigned char *)encoded + encoded_length;
+  unsigned int length, segment, stream, i;
+
+  *text_length = 0;
+
+  if (encoded_length < BPE_HUFFMAN_HEADER_SIZE)
+  {
+    return (0);
+  }
+
+  length = bpe_huffman_read_u32(encoded);
+  segment = (length + BPE_HUFFMAN_STREAMS - 1) / BPE_HUFFMAN_STREAMS;
+
+  for (stream = 0; stream < BPE_HUFFMAN_STREAMS; ++stream)
+  {
+    unsigned int size = (unsigned int)(end - data);
+
+    if (stream < BPE_HUFFMAN_STREAMS - 1)
+    {
+      unsigned int stream_size = bpe_huffman_read_u32(encoded + 4 + 4 * stream);
+
+      if (stream_size > size)
+      {
+        return (0);
+      }
+
+      size = stream_size;
+    }
+
+    streams[stream].data = data;
+    streams[stream].end = data + size;
+    streams[stream].bits = 0;
+    streams[stream].bit_count = 0;
+    streams[stream].padding_bits = 0;
+    out[stream] = text + segment * stream;
+    counts[stream] = bpe_huffman_stream_count(length, stream);
+    data += size;
+  }
+
+  /* The last stream is the shortest, until it runs out all streams decode two symbols at a time */
+  for (i = 0; i + 2 <= counts[BPE_HUFFMAN_STREAMS - 1]; i += 2)
+  {
+    bpe_huffman_refill(&streams[0]);
+    bpe_huffman_refill(&streams[1]);
+    bpe_huffman_refill(&streams[2]);
+    bpe_huffman_refill(&streams[3]);
+
+    out[0][i] = bpe_huffman_decode_symbol(huffman, &streams[0]);
+    out[1][i] = bpe_huffman_decode_symbol(huffman, &streams[1]);
+    out[2][i] = bpe_huffman_decode_symbol(huffman, &streams[2]);
+    out[3][i] = bpe_huffman_decode_symbol(huffman, &streams[3]);
+
+    out[0][i + 1] = bpe_huffman_decode_symbol(huffman, &streams[0]);
+    out[1][i + 1] = bpe_huffman_decode_symbol(huffman, &streams[1]);
+    out[2][i + 1] = bpe_huffman_decode_symbol(huffman, &streams[2]);
+    out[3][i + 1] = bpe_huffman_decode_symbol(huffman, &streams[3]);
+  }
+
+  for (stream = 0; stream < BPE_HUFFMAN_STREAMS; ++stream)
+  {
+    unsigned int k;
+
+    for (k = i; k < counts[stream]; ++k)
+    {
+      bpe_huffman_refill(&streams[stream]);
+      out[stream][k] = bpe_huffman_decode_symbol(huffman, &streams[stream]);
+    }
+  }
+
+  /* Outside of the hot loop: the padding must still be unread */
+  for (stream = 0; stream < BPE_HUFFMAN_STREAMS; ++stream)
+  {
+    if (streams[stream].bit_count < streams[stream].padding_bits)
+    {
+      return (0);
+    }
+  }
+
+  *text_length = length;
+
+  return (1);
+}
+
 #endif /* BPE_H */
 
 /*
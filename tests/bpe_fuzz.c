@@ -0,0 +1,696 @@
+/* bpe.h - v0.1 - public domain data structures - nickscha 2025
+
+A C89 standard compliant fuzz and differential harness for bpe.h.
+
+Every input runs through all encode/decode paths of bpe.h and is checked with
+- the merge choice against the spec: every merge picks the most frequent pair (ties go to
+  the lowest pair id) and the highest free character of 128..254 as replacement symbol,
+  encoding stops only when no further merge is allowed
+- invariants of every merge: expanding it restores the previous text exactly and no merged
+  pair is left in the output
+- byte exact round trips through every decoder (in place, stack based, table based, frames)
+- the rank based static encoder against the sequential dictionary encoder
+- the table driven interleaved huffman decoder against a bit by bit canonical decoder
+
+LIMITS
+    The pair counts are recomputed from the spec but the replacement itself is replayed with
+    bpe_replace_pair_in. That is covered by the expand and no pair left invariants instead.
+
+USAGE
+    # Differential run on generated inputs (or on the given corpus files)
+    cc -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all -o bpe_fuzz bpe_fuzz.c
+    ./bpe_fuzz [files...]
+
+    # libFuzzer
+    clang -O1 -g -fsanitize=fuzzer,address,undefined -DBPE_FUZZ_LIBFUZZER -o bpe_fuzz bpe_fuzz.c
+    ./bpe_fuzz corpus/
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+*/
+#include "../bpe.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BPE_FUZZ_MAX_INPUT (256 * 1024) /* Well past the former 64 KB decode buffer */
+#define BPE_FUZZ_MAX_SAMPLES (BPE_FUZZ_MAX_INPUT + 1)
+
+#define BPE_FUZZ_CHECK(exp)                                                                 \
+  do                                                                                        \
+  {                                                                                         \
+    if (!(exp))                                                                             \
+    {                                                                                       \
+      fprintf(stderr, "[bpe] %s:%d differential check failed: %s\n", __FILE__, __LINE__, #exp); \
+      abort();                                                                              \
+    }                                                                                       \
+  } while (0)
+
+static char input[BPE_FUZZ_MAX_INPUT];
+static char text[BPE_FUZZ_MAX_INPUT + 1];
+static char reference[BPE_FUZZ_MAX_INPUT + 1];
+static char scratch[BPE_FUZZ_MAX_INPUT + 1];
+static char encoded[BPE_HUFFMAN_BOUND(BPE_FUZZ_MAX_INPUT) + BPE_FRAME_HEADER_SIZE];
+static char expansion_data[BPE_FUZZ_MAX_INPUT];
+
+static char *samples[BPE_FUZZ_MAX_SAMPLES];
+static unsigned int sample_lengths[BPE_FUZZ_MAX_SAMPLES];
+static char *original_samples[BPE_FUZZ_MAX_SAMPLES];
+static unsigned int original_sample_lengths[BPE_FUZZ_MAX_SAMPLES];
+static char *replay_samples[BPE_FUZZ_MAX_SAMPLES];
+static unsigned int replay_sample_lengths[BPE_FUZZ_MAX_SAMPLES];
+static char sample_data[BPE_FUZZ_MAX_INPUT];
+static char original_sample_data[BPE_FUZZ_MAX_INPUT];
+static char replay_sample_data[BPE_FUZZ_MAX_INPUT];
+
+static unsigned int pair_counts[BPE_MAX_SYMBOLS];
+static unsigned long frequencies[BPE_NUM_CHARS];
+
+static bpe model;
+static bpe_dictionary dict;
+static bpe_static_dictionary static_dict;
+static bpe_huffman huffman;
+
+static void bpe_fuzz_copy(char *dst, const char *src, unsigned int length)
+{
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    dst[i] = src[i];
+  }
+}
+
+static int bpe_fuzz_equals(const char *a, const char *b, unsigned int length)
+{
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    if (a[i] != b[i])
+    {
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+/* #############################################################################
+ * # REFERENCE IMPLEMENTATIONS
+ * #############################################################################
+ */
+
+/* Expands every symbol to its pair, out of place */
+static unsigned int reference_expand(char *dst, const char *src, unsigned int length, unsigned short pair, unsigned char symbol)
+{
+  unsigned int i;
+  unsigned int j = 0;
+
+  for (i = 0; i < length; ++i)
+  {
+    if ((unsigned char)src[i] == symbol)
+    {
+      dst[j++] = (char)(pair >> 8);
+      dst[j++] = (char)(pair & 0xFF);
+    }
+    else
+    {
+      dst[j++] = src[i];
+    }
+  }
+
+  return (j);
+}
+
+/* Counts the occurrences of pair at any position */
+static unsigned int reference_count_pair(const char *buffer, unsigned int length, unsigned short pair)
+{
+  unsigned int count = 0;
+  unsigned int i;
+
+  for (i = 0; i + 1 < length; ++i)
+  {
+    count += (unsigned short)(((unsigned char)buffer[i] << 8) | (unsigned char)buffer[i + 1]) == pair;
+  }
+
+  return (count);
+}
+
+/* Most frequent pair of all texts (at even positions only if step is 2), ties go to the lowest
+   pair id and excluded is never picked. Returns its count. Only touched pair_counts are reset. */
+static unsigned int reference_most_frequent_pair(char **texts, const unsigned int *lengths, unsigned int count, unsigned int step, unsigned int excluded, unsigned short *pair)
+{
+  unsigned int best_count = 0;
+  unsigned int i, j, pass;
+
+  *pair = 0;
+
+  /* Pass 0 counts, pass 1 picks the best pair, pass 2 resets the counts */
+  for (pass = 0; pass < 3; ++pass)
+  {
+    for (i = 0; i < count; ++i)
+    {
+      for (j = 0; j + 1 < lengths[i]; j += step)
+      {
+        unsigned int id = ((unsigned int)(unsigned char)texts[i][j] << 8) | (unsigned char)texts[i][j + 1];
+
+        if (id == excluded)
+        {
+          continue;
+        }
+
+        if (pass == 0)
+        {
+          pair_counts[id]++;
+        }
+        else if (pass == 1 && (pair_counts[id] > best_count || (pair_counts[id] == best_count && id < *pair)))
+        {
+          best_count = pair_counts[id];
+          *pair = (unsigned short)id;
+        }
+        else if (pass == 2)
+        {
+          pair_counts[id] = 0;
+        }
+      }
+    }
+  }
+
+  return (best_count);
+}
+
+/* Highest character of 128..254 that is in none of the texts and not reserved, 0 if there is none */
+static unsigned char reference_free_symbol(char **texts, const unsigned int *lengths, unsigned int count, const unsigned char *reserved)
+{
+  unsigned char used[BPE_NUM_CHARS] = {0};
+  unsigned int i, j;
+
+  for (i = 0; i < count; ++i)
+  {
+    for (j = 0; j < lengths[i]; ++j)
+    {
+      used[(unsigned char)texts[i][j]] = 1;
+    }
+  }
+
+  for (i = 254; i >= 128; --i)
+  {
+    if (!used[i] && !(reserved && reserved[i]))
+    {
+      return ((unsigned char)i);
+    }
+  }
+
+  return (0);
+}
+
+/* Canonical huffman decoding one bit at a time, symbols sorted by (code length, symbol) */
+static unsigned int reference_huffman_decode(const bpe_huffman *code, const char *data, unsigned int data_length, char *out)
+{
+  unsigned int length_counts[BPE_HUFFMAN_MAX_CODE_LENGTH + 1] = {0};
+  unsigned char sorted[BPE_NUM_CHARS];
+  unsigned int length, segment, stream, i, n = 0;
+  const unsigned char *stream_data = (const unsigned char *)data + BPE_HUFFMAN_HEADER_SIZE;
+
+  for (length = 1; length <= BPE_HUFFMAN_MAX_CODE_LENGTH; ++length)
+  {
+    for (i = 0; i < BPE_NUM_CHARS; ++i)
+    {
+      if (code->code_lengths[i] == length)
+      {
+        sorted[n++] = (unsigned char)i;
+        length_counts[length]++;
+      }
+    }
+  }
+
+  length = bpe_huffman_read_u32(data);
+  segment = (length + BPE_HUFFMAN_STREAMS - 1) / BPE_HUFFMAN_STREAMS;
+
+  for (stream = 0; stream < BPE_HUFFMAN_STREAMS; ++stream)
+  {
+    unsigned int stream_size = stream < BPE_HUFFMAN_STREAMS - 1 ? bpe_huffman_read_u32(data + 4 + 4 * stream) : (unsigned int)((const unsigned char *)data + data_length - stream_data);
+    unsigned int bit = 0;
+
+    for (i = 0; i < bpe_huffman_stream_count(length, stream); ++i)
+    {
+      unsigned int value = 0;
+      unsigned int first = 0;
+      unsigned int index = 0;
+      unsigned int bits;
+
+      for (bits = 1; bits <= BPE_HUFFMAN_MAX_CODE_LENGTH; ++bits)
+      {
+        BPE_FUZZ_CHECK(bit / 8 < stream_size);
+        value = (value << 1) | ((stream_data[bit / 8] >> (bit % 8)) & 1);
+        bit++;
+
+        if (value - first < length_counts[bits])
+        {
+          out[segment * stream + i] = (char)sorted[index + value - first];
+          break;
+        }
+
+        index += length_counts[bits];
+        first = (first + length_counts[bits]) << 1;
+      }
+
+      BPE_FUZZ_CHECK(bits <= BPE_HUFFMAN_MAX_CODE_LENGTH);
+    }
+
+    stream_data += stream_size;
+  }
+
+  return (length);
+}
+
+/* #############################################################################
+ * # DIFFERENTIAL CHECKS
+ * #############################################################################
+ */
+
+/* bpe_forward step by step against the spec and the merge invariants, then bpe_decoded_size and bpe_decode */
+static void bpe_fuzz_model(unsigned int length)
+{
+  unsigned int reference_length = length;
+  unsigned int i;
+
+  bpe_fuzz_copy(text, input, length);
+  text[length] = '\0';
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    model.symbol_expansions[i] = 0;
+  }
+  model.text = text;
+  model.text_length = length;
+  model.iteration_count = 0;
+
+  for (;;)
+  {
+    char *texts[1];
+    unsigned short best_pair;
+    unsigned int best_count;
+    unsigned char free_symbol;
+    unsigned short pair;
+    unsigned char symbol;
+
+    /* Text before the merge and what the spec says the merge must be */
+    reference_length = model.text_length;
+    bpe_fuzz_copy(reference, model.text, reference_length);
+
+    texts[0] = reference;
+    best_count = reference_most_frequent_pair(texts, &reference_length, 1, 2, BPE_MAX_SYMBOLS - 1, &best_pair);
+    free_symbol = reference_free_symbol(texts, &reference_length, 1, 0);
+
+    if (!bpe_forward(&model))
+    {
+      /* Encoding only stops when no further merge is allowed */
+      BPE_FUZZ_CHECK(model.text_length == reference_length);
+      BPE_FUZZ_CHECK(model.iteration_count == BPE_MAX_ITERATIONS || free_symbol == 0 || best_count <= 1);
+      break;
+    }
+
+    pair = model.replacement_pairs[model.iteration_count - 1];
+    symbol = model.replacement_symbols[model.iteration_count - 1];
+
+    /* The most frequent pair at even positions and the highest free symbol */
+    BPE_FUZZ_CHECK(best_count >= 2);
+    BPE_FUZZ_CHECK(pair == best_pair);
+    BPE_FUZZ_CHECK(model.most_frequent_pair_count == best_count);
+    BPE_FUZZ_CHECK(symbol == free_symbol);
+
+    /* Greedy left to right replacement leaves no occurrence of the pair */
+    BPE_FUZZ_CHECK(reference_count_pair(model.text, model.text_length, pair) == 0);
+    BPE_FUZZ_CHECK(model.replacement_count == reference_length - model.text_length);
+    BPE_FUZZ_CHECK(model.replacement_count >= 2);
+
+    /* Expanding the merge restores the previous text */
+    BPE_FUZZ_CHECK(reference_expand(scratch, model.text, model.text_length, pair, symbol) == reference_length);
+    BPE_FUZZ_CHECK(bpe_fuzz_equals(scratch, reference, reference_length));
+
+    BPE_FUZZ_CHECK(bpe_decoded_size(&model, model.text, model.text_length) == length);
+  }
+
+  BPE_FUZZ_CHECK(bpe_decoded_size(&model, model.text, model.text_length) == length);
+
+  /* Reference decode: expand the merges in reverse order */
+  reference_length = model.text_length;
+  bpe_fuzz_copy(reference, model.text, reference_length);
+
+  for (i = model.iteration_count; i > 0; --i)
+  {
+    reference_length = reference_expand(scratch, reference, reference_length, model.replacement_pairs[i - 1], model.replacement_symbols[i - 1]);
+    bpe_fuzz_copy(reference, scratch, reference_length);
+  }
+
+  BPE_FUZZ_CHECK(reference_length == length);
+  BPE_FUZZ_CHECK(bpe_fuzz_equals(reference, input, length));
+
+  bpe_decode(&model);
+
+  BPE_FUZZ_CHECK(model.text_length == length);
+  BPE_FUZZ_CHECK(bpe_fuzz_equals(model.text, input, length));
+}
+
+/* Splits the input into '\n' separated samples */
+static unsigned int bpe_fuzz_split(char *data, char **parts, unsigned int *part_lengths, unsigned int length)
+{
+  unsigned int count = 0;
+  unsigned int i;
+
+  bpe_fuzz_copy(data, input, length);
+
+  parts[0] = data;
+  part_lengths[0] = 0;
+
+  for (i = 0; i < length; ++i)
+  {
+    if (data[i] == '\n')
+    {
+      count++;
+      parts[count] = data + i + 1;
+      part_lengths[count] = 0;
+    }
+    else
+    {
+      part_lengths[count]++;
+    }
+  }
+
+  return (count + 1);
+}
+
+/* No pair of the dictionary may be left in text after encoding */
+static int bpe_fuzz_has_merged_pair(const bpe_static_dictionary *ranks, const char *buffer, unsigned int length)
+{
+  unsigned int i;
+
+  for (i = 0; i + 1 < length; ++i)
+  {
+    if (ranks->pair_ranks[bpe_convert_pair_to_id((unsigned char)buffer[i], (unsigned char)buffer[i + 1])])
+    {
+      return (1);
+    }
+  }
+
+  return (0);
+}
+
+/* Dictionary training invariants, the ranked static encoder against the sequential encoder, decoders and frames */
+static void bpe_fuzz_dictionary(unsigned int length)
+{
+  unsigned int sample_count = bpe_fuzz_split(sample_data, samples, sample_lengths, length);
+  unsigned int training_count = (sample_count + 1) / 2;
+  unsigned char used[BPE_NUM_CHARS] = {0};
+  unsigned char reserved[BPE_NUM_CHARS] = {0};
+  unsigned int expansion_length;
+  unsigned short best_pair;
+  unsigned int best_count;
+  unsigned char free_symbol;
+  unsigned int i, j, k;
+
+  bpe_fuzz_split(original_sample_data, original_samples, original_sample_lengths, length);
+  bpe_fuzz_split(replay_sample_data, replay_samples, replay_sample_lengths, length);
+
+  /* Train on the first half of the samples */
+  BPE_FUZZ_CHECK(!bpe_dictionary_train(&dict, BPE_FRAME_RAW, samples, sample_lengths, training_count));
+  BPE_FUZZ_CHECK(bpe_dictionary_train(&dict, 1, samples, sample_lengths, training_count));
+  BPE_FUZZ_CHECK(bpe_static_dictionary_build(&dict, &static_dict, expansion_data, BPE_FUZZ_MAX_INPUT, &expansion_length));
+  BPE_FUZZ_CHECK((expansion_length == 0) == (dict.merge_count == 0));
+
+  /* Replacement symbols are unique and never occur in the training samples */
+  for (i = 0; i < training_count; ++i)
+  {
+    for (j = 0; j < original_sample_lengths[i]; ++j)
+    {
+      used[(unsigned char)original_samples[i][j]] = 1;
+    }
+  }
+
+  for (i = 0; i < dict.merge_count; ++i)
+  {
+    unsigned char symbol = dict.replacement_symbols[i];
+
+    BPE_FUZZ_CHECK(symbol >= 128 && symbol < 255);
+    BPE_FUZZ_CHECK(!used[symbol]);
+    BPE_FUZZ_CHECK(dict.reserved_symbols[symbol]);
+    BPE_FUZZ_CHECK(dict.symbol_pairs[symbol] == dict.replacement_pairs[i]);
+    used[symbol] = 1;
+  }
+
+  /* Replay the training: every merge takes the most frequent pair within the samples (ties go
+     to the lowest pair id) and the highest character in no original sample and not yet reserved */
+  for (i = 0;; ++i)
+  {
+    best_count = reference_most_frequent_pair(replay_samples, replay_sample_lengths, training_count, 1, BPE_MAX_SYMBOLS, &best_pair);
+    free_symbol = reference_free_symbol(original_samples, original_sample_lengths, training_count, reserved);
+
+    if (i == dict.merge_count)
+    {
+      BPE_FUZZ_CHECK(dict.merge_count == BPE_MAX_ITERATIONS || best_count <= 1 || free_symbol == 0);
+      break;
+    }
+
+    BPE_FUZZ_CHECK(best_count >= 2);
+    BPE_FUZZ_CHECK(dict.replacement_pairs[i] == best_pair);
+    BPE_FUZZ_CHECK(dict.replacement_symbols[i] == free_symbol);
+
+    for (k = 0; k < training_count; ++k)
+    {
+      replay_sample_lengths[k] = bpe_replace_pair_in(replay_samples[k], replay_sample_lengths[k], best_pair, free_symbol);
+    }
+    reserved[free_symbol] = 1;
+  }
+
+  for (k = 0; k < training_count; ++k)
+  {
+    BPE_FUZZ_CHECK(replay_sample_lengths[k] == sample_lengths[k]);
+    BPE_FUZZ_CHECK(bpe_fuzz_equals(replay_samples[k], samples[k], sample_lengths[k]));
+  }
+
+  /* The trained samples are what encoding the originals yields and decode back to them */
+  for (i = 0; i < training_count; ++i)
+  {
+    unsigned int encoded_length = original_sample_lengths[i];
+
+    bpe_fuzz_copy(text, original_samples[i], encoded_length);
+
+    BPE_FUZZ_CHECK(bpe_dictionary_encode(&dict, text, &encoded_length));
+    BPE_FUZZ_CHECK(encoded_length == sample_lengths[i]);
+    BPE_FUZZ_CHECK(bpe_fuzz_equals(text, samples[i], encoded_length));
+    BPE_FUZZ_CHECK(!bpe_fuzz_has_merged_pair(&static_dict, samples[i], sample_lengths[i]));
+
+    BPE_FUZZ_CHECK(bpe_dictionary_decode(&dict, samples[i], sample_lengths[i], scratch) == original_sample_lengths[i]);
+    BPE_FUZZ_CHECK(bpe_fuzz_equals(scratch, original_samples[i], original_sample_lengths[i]));
+  }
+
+  /* Encode every sample (seen and unseen in training) with all encoders */
+  for (k = 0; k < sample_count; ++k)
+  {
+    const char *message = original_samples[k];
+    unsigned int message_length = original_sample_lengths[k];
+    unsigned int encoded_length = message_length;
+    unsigned int static_length = message_length;
+    unsigned int frame_length;
+    unsigned int decoded_length;
+    bpe_bool encodable = 1;
+
+    for (i = 0; i < message_length; ++i)
+    {
+      encodable = encodable && !dict.reserved_symbols[(unsigned char)message[i]];
+    }
+
+    bpe_fuzz_copy(text, message, message_length);
+    bpe_fuzz_copy(reference, message, message_length);
+
+    BPE_FUZZ_CHECK(bpe_dictionary_encode(&dict, text, &encoded_length) == encodable);
+    BPE_FUZZ_CHECK(bpe_static_encode(&static_dict, reference, &static_length) == encodable);
+
+    if (encodable)
+    {
+      /* Sequential merges and lowest rank first merges must agree */
+      BPE_FUZZ_CHECK(encoded_length == static_length);
+      BPE_FUZZ_CHECK(bpe_fuzz_equals(text, reference, encoded_length));
+      BPE_FUZZ_CHECK(!bpe_fuzz_has_merged_pair(&static_dict, text, encoded_length));
+
+      BPE_FUZZ_CHECK(bpe_dictionary_decoded_size(&dict, text, encoded_length) == message_length);
+      BPE_FUZZ_CHECK(bpe_static_decoded_size(&static_dict, text, encoded_length) == message_length);
+
+      BPE_FUZZ_CHECK(bpe_dictionary_decode(&dict, text, encoded_length, scratch) == message_length);
+      BPE_FUZZ_CHECK(bpe_fuzz_equals(scratch, message, message_length));
+
+      BPE_FUZZ_CHECK(bpe_static_decode(&static_dict, text, encoded_length, scratch) == message_length);
+      BPE_FUZZ_CHECK(bpe_fuzz_equals(scratch, message, message_length));
+    }
+
+    frame_length = bpe_frame_encode(&dict, message, message_length, encoded);
+
+    BPE_FUZZ_CHECK(bpe_frame_dictionary_id(encoded) == (encodable ? dict.id : BPE_FRAME_RAW));
+    BPE_FUZZ_CHECK(bpe_frame_decode(&dict, encoded, frame_length, scratch, &decoded_length));
+    BPE_FUZZ_CHECK(decoded_length == message_length);
+    BPE_FUZZ_CHECK(bpe_fuzz_equals(scratch, message, message_length));
+  }
+}
+
+/* Huffman round trips against the bit by bit reference decoder */
+static void bpe_fuzz_huffman(unsigned int length)
+{
+  unsigned int half = length / 2;
+  unsigned int encoded_length;
+  unsigned int decoded_length;
+  unsigned int i;
+
+  /* Frequencies of the first half only so that unseen symbols get the longest codes */
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    frequencies[i] = 0;
+  }
+  bpe_huffman_count(frequencies, input, half);
+  bpe_huffman_build(&huffman, frequencies);
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    BPE_FUZZ_CHECK(huffman.code_lengths[i] > 0 && huffman.code_lengths[i] <= BPE_HUFFMAN_MAX_CODE_LENGTH);
+  }
+
+  encoded_length = bpe_huffman_encode(&huffman, input, length, encoded);
+
+  BPE_FUZZ_CHECK(encoded_length >= BPE_HUFFMAN_HEADER_SIZE);
+  BPE_FUZZ_CHECK(encoded_length <= BPE_HUFFMAN_BOUND(length));
+  BPE_FUZZ_CHECK(bpe_huffman_decoded_size(encoded) == length);
+
+  BPE_FUZZ_CHECK(bpe_huffman_decode(&huffman, encoded, encoded_length, text, &decoded_length));
+  BPE_FUZZ_CHECK(decoded_length == length);
+  BPE_FUZZ_CHECK(bpe_fuzz_equals(text, input, length));
+
+  BPE_FUZZ_CHECK(reference_huffman_decode(&huffman, encoded, encoded_length, reference) == length);
+  BPE_FUZZ_CHECK(bpe_fuzz_equals(reference, input, length));
+
+  /* Truncated input must be rejected without reading out of bounds */
+  for (i = 1; i <= 8 && i <= encoded_length - BPE_HUFFMAN_HEADER_SIZE; ++i)
+  {
+    BPE_FUZZ_CHECK(!bpe_huffman_decode(&huffman, encoded, encoded_length - i, text, &decoded_length));
+  }
+}
+
+static void bpe_fuzz_run(const unsigned char *data, unsigned int length)
+{
+  unsigned int i;
+
+  if (length > BPE_FUZZ_MAX_INPUT)
+  {
+    length = BPE_FUZZ_MAX_INPUT;
+  }
+
+  for (i = 0; i < length; ++i)
+  {
+    input[i] = (char)data[i];
+  }
+
+  bpe_fuzz_model(length);
+  bpe_fuzz_dictionary(length);
+  bpe_fuzz_huffman(length);
+}
+
+#ifdef BPE_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+  bpe_fuzz_run(data, size > BPE_FUZZ_MAX_INPUT ? BPE_FUZZ_MAX_INPUT : (unsigned int)size);
+  return (0);
+}
+
+#else
+
+static unsigned char generated[BPE_FUZZ_MAX_INPUT];
+static unsigned long bpe_fuzz_state = 2463534242UL;
+
+static unsigned long bpe_fuzz_random(void)
+{
+  /* xorshift32 */
+  bpe_fuzz_state ^= (bpe_fuzz_state << 13) & 0xFFFFFFFFUL;
+  bpe_fuzz_state ^= bpe_fuzz_state >> 17;
+  bpe_fuzz_state ^= (bpe_fuzz_state << 5) & 0xFFFFFFFFUL;
+  return (bpe_fuzz_state);
+}
+
+/* Inputs with high bytes, embedded NULs, runs, small alphabets and lengths past 64 KB */
+static unsigned int bpe_fuzz_generate(unsigned int iteration)
+{
+  static const unsigned int lengths[] = {0, 1, 2, 3, 7, 64, 509, 4096, 65535, 65536, 65537, 70000, BPE_FUZZ_MAX_INPUT};
+  unsigned int length = iteration < sizeof(lengths) / sizeof(lengths[0]) ? lengths[iteration] : (unsigned int)(bpe_fuzz_random() % 8192);
+  unsigned int alphabet = (unsigned int)(bpe_fuzz_random() % 4);
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    unsigned long r = bpe_fuzz_random();
+
+    switch (alphabet)
+    {
+    case 0: /* Full byte range including NUL and 128..255 */
+      generated[i] = (unsigned char)(r & 0xFF);
+      break;
+    case 1: /* Few symbols, many repeated pairs */
+      generated[i] = (unsigned char)("ab\0\n\xFE\xFF"[r % 6]);
+      break;
+    case 2: /* Runs of the previous byte */
+      generated[i] = (i > 0 && (r % 4) != 0) ? generated[i - 1] : (unsigned char)((r >> 8) & 0xFF);
+      break;
+    default: /* Line based text */
+      generated[i] = (unsigned char)((r % 16) == 0 ? '\n' : 'a' + (r >> 8) % 8);
+      break;
+    }
+  }
+
+  return (length);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int cases = 0;
+  int i;
+
+  if (argc > 1)
+  {
+    /* Replay the given files, e.g. a libFuzzer corpus or crash */
+    for (i = 1; i < argc; ++i)
+    {
+      FILE *file = fopen(argv[i], "rb");
+      size_t length;
+
+      if (!file)
+      {
+        fprintf(stderr, "[bpe] cannot open %s\n", argv[i]);
+        return (1);
+      }
+
+      length = fread(generated, 1, BPE_FUZZ_MAX_INPUT, file);
+      fclose(file);
+
+      bpe_fuzz_run(generated, (unsigned int)length);
+      cases++;
+    }
+  }
+  else
+  {
+    for (i = 0; i < 200; ++i)
+    {
+      bpe_fuzz_run(generated, bpe_fuzz_generate((unsigned int)i));
+      cases++;
+    }
+  }
+
+  printf("[bpe] fuzz: %u differential cases passed\n", cases);
+
+  return (0);
+}
+
+#endif
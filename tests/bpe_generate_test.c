@@ -0,0 +1,95 @@
+/* bpe.h - v0.1 - public domain data structures - nickscha 2025
+
+A C89 standard compliant test for the header emitted by tools/bpe_generate.c.
+
+USAGE
+    bpe_generate samples.txt bpe_generate_test_dictionary 1 > tests/bpe_generate_test_dictionary.h
+    cc -std=c89 -pedantic -Werror ... -o bpe_generate_test tests/bpe_generate_test.c
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+*/
+#include "../bpe.h"
+#include "test.h" /* Simple testing framework */
+#include "bpe_generate_test_dictionary.h"
+
+void bpe_generate_test_round_trip(void)
+{
+  char message[] = "{\"id\":4711,\"temp\":21,\"unit\":\"C\",\"status\":\"ok\"}";
+  char decoded[BPE_STRLEN(message)];
+  char *text = message;
+  unsigned int length = BPE_STRLEN(message);
+  unsigned int decoded_length;
+  unsigned int i;
+
+  assert(bpe_generate_test_dictionary.id == 1);
+  assert(bpe_generate_test_dictionary.merge_count > 0);
+
+  assert(bpe_static_encode(&bpe_generate_test_dictionary, text, &length));
+
+  printf("[bpe] generated dictionary merges: %d, message: %d, encoded: %d\n", bpe_generate_test_dictionary.merge_count, (int)BPE_STRLEN(message), length);
+
+  assert(length < BPE_STRLEN(message));
+  assert(bpe_static_decoded_size(&bpe_generate_test_dictionary, text, length) == BPE_STRLEN(message));
+
+  decoded_length = bpe_static_decode(&bpe_generate_test_dictionary, text, length, decoded);
+
+  assert(decoded_length == BPE_STRLEN(message));
+  for (i = 0; i < decoded_length; ++i)
+  {
+    assert(decoded[i] == "{\"id\":4711,\"temp\":21,\"unit\":\"C\",\"status\":\"ok\"}"[i]);
+  }
+}
+
+int main(void)
+{
+  bpe_generate_test_round_trip();
+
+  return 0;
+}
+
+
+/*
+   ------------------------------------------------------------------------------
+   This software is available under 2 licenses -- choose whichever you prefer.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE A - MIT License
+   Copyright (c) 2025 nickscha
+   Permission is hereby granted, free of charge, to any person obtaining a copy of
+   this software and associated documentation files (the "Software"), to deal in
+   the Software without restriction, including without limitation the rights to
+   use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+   of the Software, and to permit persons to whom the Software is furnished to do
+   so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE B - Public Domain (www.unlicense.org)
+   This is free and unencumbered software released into the public domain.
+   Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+   software, either in source code form or as a compiled binary, for any purpose,
+   commercial or non-commercial, and by any means.
+   In jurisdictions that recognize copyright laws, the author or authors of this
+   software dedicate any and all copyright interest in the software to the public
+   domain. We make this dedication for the benefit of the public at large and to
+   the detriment of our heirs and successors. We intend this dedication to be an
+   overt act of relinquishment in perpetuity of all present and future rights to
+   this software under copyright law.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+   WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+   ------------------------------------------------------------------------------
+*/
@@ -148,6 +148,400 @@ void bpe_test_decode_long_text(void)
   assert(finalModel.text_length == 508);
 }
 
+void bpe_test_decoded_size(void)
+{
+  char input[] = "abababab";
+  char input_long[] = "Lorem ipsum dolor sit amet, consetetur sadipscing elitr, sed diam nonumy eirmod tempor invidunt ut labore et dolore magna aliquyam erat, sed diam voluptua. At vero eos et accusam et justo duo dolores et ea rebum. Stet clita kasd gubergren, no sea takimata sanctus est Lorem ipsum dolor sit amet. Lorem ipsum dolor sit amet, consetetur sadipscing elitr, sed diam nonumy eirmod tempor invidunt ut labore et dolore magna aliquyam erat, sed diam voluptua. At vero eos et accusam et justo duo dolores et ea rebum.";
+  bpe finalModel = bpe_test_process(input, BPE_STRLEN(input));
+
+  assert(finalModel.text_length == 2);
+  assert(finalModel.symbol_expansions[(unsigned char)finalModel.text[0]] == 3);
+  assert(bpe_decoded_size(&finalModel, finalModel.text, finalModel.text_length) == 8);
+
+  finalModel = bpe_test_process(input_long, BPE_STRLEN(input_long));
+
+  assert(finalModel.text_length == 243);
+  assert(bpe_decoded_size(&finalModel, finalModel.text, finalModel.text_length) == 508);
+
+  bpe_decode(&finalModel);
+
+  assert(finalModel.text_length == 508);
+}
+
+bpe_bool bpe_test_equals(const char *a, const char *b, unsigned int length)
+{
+  unsigned int i;
+
+  for (i = 0; i < length; ++i)
+  {
+    if (a[i] != b[i])
+    {
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+void bpe_test_uneven_last_char_not_used_as_symbol(void)
+{
+  char input[] = "aaaa\xFE";
+  bpe finalModel = bpe_test_process(input, BPE_STRLEN(input));
+
+  /* The last character of an uneven text is not part of a counted pair but still used */
+  assert(finalModel.iteration_count == 1);
+  assert(finalModel.replacement_symbols[0] != (unsigned char)'\xFE');
+  assert(bpe_decoded_size(&finalModel, finalModel.text, finalModel.text_length) == BPE_STRLEN(input));
+
+  bpe_decode(&finalModel);
+
+  assert(finalModel.text_length == BPE_STRLEN(input));
+  assert(bpe_test_equals(finalModel.text, "aaaa\xFE", BPE_STRLEN(input)));
+}
+
+void bpe_test_embedded_nul(void)
+{
+  char input[] = "ab\0abab\0ab";
+  bpe finalModel = bpe_test_process(input, BPE_STRLEN(input));
+
+  /* Replacement continues past the '\0' */
+  assert(finalModel.iteration_count > 0);
+  assert(finalModel.replacement_count == 4);
+  assert(finalModel.text_length == 6);
+  assert(bpe_decoded_size(&finalModel, finalModel.text, finalModel.text_length) == BPE_STRLEN(input));
+
+  bpe_decode(&finalModel);
+
+  assert(finalModel.text_length == BPE_STRLEN(input));
+  assert(bpe_test_equals(finalModel.text, "ab\0abab\0ab", BPE_STRLEN(input)));
+}
+
+void bpe_test_no_free_symbol(void)
+{
+  char input[4 + 127 + 1];
+  char original[4 + 127];
+  unsigned int i;
+  bpe model = {0};
+
+  /* Every candidate replacement symbol (128..254) is already used */
+  for (i = 0; i < 4; ++i)
+  {
+    input[i] = (char)"abab"[i];
+  }
+  for (i = 0; i < 127; ++i)
+  {
+    input[4 + i] = (char)(128 + i);
+  }
+  input[4 + 127] = '\0';
+
+  for (i = 0; i < 4 + 127; ++i)
+  {
+    original[i] = input[i];
+  }
+
+  model.text = input;
+  model.text_length = 4 + 127;
+
+  assert(!bpe_forward(&model));
+  assert(model.iteration_count == 0);
+  assert(model.text_length == 4 + 127);
+  assert(bpe_test_equals(model.text, original, 4 + 127));
+}
+
+void bpe_test_decode_past_64kb(void)
+{
+  static char input[70000 + 1];
+  static char original[70000];
+  static bpe model;
+  unsigned int i;
+
+  for (i = 0; i < 70000; ++i)
+  {
+    input[i] = (char)"abcdefgh"[(i / 3) % 8];
+    original[i] = input[i];
+  }
+
+  model.text = input;
+  model.text_length = 70000;
+
+  while (bpe_forward(&model))
+  {
+  }
+
+  assert(model.text_length < 70000);
+  assert(bpe_decoded_size(&model, model.text, model.text_length) == 70000);
+
+  /* Decoding expands in place and needs no 64 KB buffer */
+  bpe_decode(&model);
+
+  assert(model.text_length == 70000);
+  assert(bpe_test_equals(model.text, original, 70000));
+}
+
+void bpe_test_train_dictionary(bpe_dictionary *dict)
+{
+  char sample0[] = "{\"temp\":21,\"unit\":\"C\"}";
+  char sample1[] = "{\"temp\":19,\"unit\":\"C\"}";
+  char sample2[] = "{\"temp\":23,\"unit\":\"F\"}";
+  char sample3[] = "{\"temp\":17,\"unit\":\"C\"}";
+  char *samples[4];
+  unsigned int sample_lengths[4];
+
+  samples[0] = sample0;
+  samples[1] = sample1;
+  samples[2] = sample2;
+  samples[3] = sample3;
+  sample_lengths[0] = BPE_STRLEN(sample0);
+  sample_lengths[1] = BPE_STRLEN(sample1);
+  sample_lengths[2] = BPE_STRLEN(sample2);
+  sample_lengths[3] = BPE_STRLEN(sample3);
+
+  assert(bpe_dictionary_train(dict, 7, samples, sample_lengths, 4));
+}
+
+void bpe_test_dictionary(void)
+{
+  char message[] = "{\"temp\":20,\"unit\":\"F\"}";
+  char frame[BPE_STRLEN(message) + BPE_FRAME_HEADER_SIZE];
+  char decoded[BPE_STRLEN(message)];
+  unsigned int frame_length;
+  unsigned int decoded_length;
+  unsigned int i;
+
+  char message_raw[] = "\xFE\xFE\xFE";
+  char frame_raw[BPE_STRLEN(message_raw) + BPE_FRAME_HEADER_SIZE];
+
+  static bpe_dictionary dict;
+
+  bpe_test_train_dictionary(&dict);
+
+  assert(dict.merge_count > 0);
+
+  /* A single message does not compress on its own but with the shared dictionary */
+  frame_length = bpe_frame_encode(&dict, message, BPE_STRLEN(message), frame);
+
+  printf("[bpe] dictionary merges: %d, message: %d, frame: %d\n", dict.merge_count, (int)BPE_STRLEN(message), frame_length);
+
+  assert(bpe_frame_dictionary_id(frame) == 7);
+  assert(frame_length < BPE_STRLEN(message));
+  assert(bpe_dictionary_decoded_size(&dict, frame + BPE_FRAME_HEADER_SIZE, frame_length - BPE_FRAME_HEADER_SIZE) == BPE_STRLEN(message));
+
+  assert(bpe_frame_decode(&dict, frame, frame_length, decoded, &decoded_length));
+  assert(decoded_length == BPE_STRLEN(message));
+  for (i = 0; i < decoded_length; ++i)
+  {
+    assert(decoded[i] == message[i]);
+  }
+
+  /* Messages containing a replacement symbol are sent raw */
+  frame_length = bpe_frame_encode(&dict, message_raw, BPE_STRLEN(message_raw), frame_raw);
+
+  assert(bpe_frame_dictionary_id(frame_raw) == BPE_FRAME_RAW);
+  assert(frame_length == BPE_STRLEN(message_raw) + BPE_FRAME_HEADER_SIZE);
+  assert(bpe_frame_decode(&dict, frame_raw, frame_length, decoded, &decoded_length));
+  assert(decoded_length == BPE_STRLEN(message_raw));
+  assert(decoded[0] == message_raw[0]);
+
+  /* An empty message is not an error */
+  frame_length = bpe_frame_encode(&dict, message, 0, frame);
+
+  assert(frame_length == BPE_FRAME_HEADER_SIZE);
+  assert(bpe_frame_decode(&dict, frame, frame_length, decoded, &decoded_length));
+  assert(decoded_length == 0);
+
+  /* Frames of another dictionary and truncated frames are */
+  frame[0] = 8;
+  assert(!bpe_frame_decode(&dict, frame, frame_length, decoded, &decoded_length));
+  assert(!bpe_frame_decode(&dict, frame, 1, decoded, &decoded_length));
+}
+
+void bpe_test_dictionary_raw_id(void)
+{
+  char sample0[] = "hello world";
+  char sample1[] = "hello world";
+  char *samples[2];
+  unsigned int sample_lengths[2];
+
+  char message[] = "hello world";
+  char frame[BPE_STRLEN(message) + BPE_FRAME_HEADER_SIZE];
+  char decoded[BPE_STRLEN(message)];
+  unsigned int frame_length;
+  unsigned int decoded_length;
+  unsigned int i;
+
+  static bpe_dictionary dict;
+
+  samples[0] = sample0;
+  samples[1] = sample1;
+  sample_lengths[0] = BPE_STRLEN(sample0);
+  sample_lengths[1] = BPE_STRLEN(sample1);
+
+  /* The raw frame id cannot be used as dictionary id */
+  assert(!bpe_dictionary_train(&dict, BPE_FRAME_RAW, samples, sample_lengths, 2));
+  assert(dict.merge_count == 0);
+
+  /* A trained dictionary whose id was reset to BPE_FRAME_RAW must still produce decodable frames */
+  assert(bpe_dictionary_train(&dict, 1, samples, sample_lengths, 2));
+  assert(dict.merge_count > 0);
+  dict.id = BPE_FRAME_RAW;
+
+  frame_length = bpe_frame_encode(&dict, message, BPE_STRLEN(message), frame);
+
+  assert(bpe_frame_dictionary_id(frame) == BPE_FRAME_RAW);
+  assert(frame_length == BPE_STRLEN(message) + BPE_FRAME_HEADER_SIZE);
+  assert(bpe_frame_decode(&dict, frame, frame_length, decoded, &decoded_length));
+  assert(decoded_length == BPE_STRLEN(message));
+  for (i = 0; i < decoded_length; ++i)
+  {
+    assert(decoded[i] == message[i]);
+  }
+}
+
+void bpe_test_static_dictionary(void)
+{
+  char message[] = "{\"temp\":20,\"unit\":\"F\"}";
+  char message_static[] = "{\"temp\":20,\"unit\":\"F\"}";
+  char decoded[BPE_STRLEN(message)];
+  char expansion_data[1024];
+  unsigned int expansion_length;
+  unsigned int length = BPE_STRLEN(message);
+  unsigned int length_static = BPE_STRLEN(message_static);
+  unsigned int decoded_length;
+  unsigned int i;
+
+  static bpe_dictionary dict;
+  static bpe_static_dictionary static_dict;
+
+  bpe_test_train_dictionary(&dict);
+
+  assert(bpe_static_dictionary_build(&dict, &static_dict, expansion_data, sizeof(expansion_data), &expansion_length));
+  assert(expansion_length > 0);
+  assert(!bpe_static_dictionary_build(&dict, &static_dict, expansion_data, 1, &expansion_length));
+  assert(expansion_length == 0);
+  assert(bpe_static_dictionary_build(&dict, &static_dict, expansion_data, sizeof(expansion_data), &expansion_length));
+  assert(expansion_length > 0);
+
+  /* The rank based encoder must produce the same output as running all merges in order */
+  assert(bpe_dictionary_encode(&dict, message, &length));
+  assert(bpe_static_encode(&static_dict, message_static, &length_static));
+  assert(length_static == length);
+  for (i = 0; i < length; ++i)
+  {
+    assert(message_static[i] == message[i]);
+  }
+
+  assert(bpe_static_decoded_size(&static_dict, message_static, length_static) == BPE_STRLEN(message));
+
+  decoded_length = bpe_static_decode(&static_dict, message_static, length_static, decoded);
+
+  assert(decoded_length == BPE_STRLEN(message));
+  for (i = 0; i < decoded_length; ++i)
+  {
+    assert(decoded[i] == "{\"temp\":20,\"unit\":\"F\"}"[i]);
+  }
+}
+
+void bpe_test_static_dictionary_without_merges(void)
+{
+  char sample[] = "abcdef";
+  char *samples[1];
+  unsigned int sample_lengths[1];
+  char expansion_data[1];
+  unsigned int expansion_length = 1;
+
+  static bpe_dictionary dict;
+  static bpe_static_dictionary static_dict;
+
+  samples[0] = sample;
+  sample_lengths[0] = BPE_STRLEN(sample);
+
+  assert(bpe_dictionary_train(&dict, 7, samples, sample_lengths, 1));
+  assert(dict.merge_count == 0);
+
+  /* A dictionary without merges is valid and needs no expansion data */
+  assert(bpe_static_dictionary_build(&dict, &static_dict, expansion_data, 0, &expansion_length));
+  assert(expansion_length == 0);
+  assert(static_dict.merge_count == 0);
+}
+
+void bpe_test_huffman(void)
+{
+  char input[] = "Lorem ipsum dolor sit amet, consetetur sadipscing elitr, sed diam nonumy eirmod tempor invidunt ut labore et dolore magna aliquyam erat, sed diam voluptua. At vero eos et accusam et justo duo dolores et ea rebum. Stet clita kasd gubergren, no sea takimata sanctus est Lorem ipsum dolor sit amet. Lorem ipsum dolor sit amet, consetetur sadipscing elitr, sed diam nonumy eirmod tempor invidunt ut labore et dolore magna aliquyam erat, sed diam voluptua. At vero eos et accusam et justo duo dolores et ea rebum.";
+  char encoded[BPE_HUFFMAN_BOUND(BPE_STRLEN(input))];
+  char decoded[BPE_STRLEN(input)];
+  unsigned int encoded_length;
+  unsigned int decoded_length;
+  unsigned int i;
+
+  static unsigned long frequencies[BPE_NUM_CHARS];
+  static bpe_huffman huffman;
+  static bpe_huffman huffman_shared;
+
+  bpe finalModel = bpe_test_process(input, BPE_STRLEN(input));
+
+  /* Second stage on the final symbols of the model */
+  bpe_huffman_count(frequencies, finalModel.text, finalModel.text_length);
+  bpe_huffman_build(&huffman, frequencies);
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    assert(huffman.code_lengths[i] > 0 && huffman.code_lengths[i] <= BPE_HUFFMAN_MAX_CODE_LENGTH);
+  }
+
+  encoded_length = bpe_huffman_encode(&huffman, finalModel.text, finalModel.text_length, encoded);
+
+  printf("[bpe] huffman: %d -> %d\n", finalModel.text_length, encoded_length);
+
+  assert(encoded_length > 0 && encoded_length < finalModel.text_length);
+  assert(bpe_huffman_decoded_size(encoded) == finalModel.text_length);
+
+  /* Only the code lengths need to be shared */
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    huffman_shared.code_lengths[i] = huffman.code_lengths[i];
+  }
+  assert(bpe_huffman_build_codes(&huffman_shared));
+
+  assert(bpe_huffman_decode(&huffman_shared, encoded, encoded_length, decoded, &decoded_length));
+
+  assert(decoded_length == finalModel.text_length);
+  for (i = 0; i < decoded_length; ++i)
+  {
+    assert(decoded[i] == finalModel.text[i]);
+  }
+
+  /* Highly skewed frequencies must still be limited to BPE_HUFFMAN_MAX_CODE_LENGTH */
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    frequencies[i] = i < 32 ? 1UL << (i % 31) : 0;
+  }
+  bpe_huffman_build(&huffman, frequencies);
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    assert(huffman.code_lengths[i] > 0 && huffman.code_lengths[i] <= BPE_HUFFMAN_MAX_CODE_LENGTH);
+    decoded[i] = (char)i;
+  }
+
+  encoded_length = bpe_huffman_encode(&huffman, decoded, BPE_NUM_CHARS, encoded);
+  assert(bpe_huffman_decode(&huffman, encoded, encoded_length, decoded, &decoded_length));
+  assert(decoded_length == BPE_NUM_CHARS);
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    assert((unsigned char)decoded[i] == i);
+  }
+
+  /* Truncated input is rejected instead of decoding the missing bits as zeros */
+  assert(!bpe_huffman_decode(&huffman, encoded, encoded_length - 1, decoded, &decoded_length));
+  assert(!bpe_huffman_decode(&huffman, encoded, encoded_length - 2, decoded, &decoded_length));
+  assert(decoded_length == 0);
+
+  /* An empty message is valid and not an error */
+  encoded_length = bpe_huffman_encode(&huffman, decoded, 0, encoded);
+  assert(bpe_huffman_decode(&huffman, encoded, encoded_length, decoded, &decoded_length));
+  assert(decoded_length == 0);
+}
+
 void bpe_test_unicode_to_utf8(void)
 {
   int i;
@@ -205,6 +599,16 @@ int main(void)
   bpe_test_long_text();
   bpe_test_decode();
   bpe_test_decode_long_text();
+  bpe_test_decoded_size();
+  bpe_test_uneven_last_char_not_used_as_symbol();
+  bpe_test_embedded_nul();
+  bpe_test_no_free_symbol();
+  bpe_test_decode_past_64kb();
+  bpe_test_dictionary();
+  bpe_test_dictionary_raw_id();
+  bpe_test_static_dictionary();
+  bpe_test_static_dictionary_without_merges();
+  bpe_test_huffman();
   bpe_test_unicode_to_utf8();
   bpe_test_utf8_to_unicode();
 
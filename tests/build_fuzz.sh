@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds and runs the differential fuzz harness with address and undefined behaviour sanitizers.
+# Pass "libfuzzer" to build the libFuzzer entry point instead (clang only).
+
+DEF_FLAGS_COMPILER="-std=c89 -pedantic -Wall -Wextra -Werror -Wvla -Wconversion -Wdouble-promotion -Wsign-conversion -Wuninitialized -Winit-self -Wunused -Wunused-macros -Wunused-local-typedefs"
+DEF_FLAGS_SANITIZER="-fsanitize=address,undefined -fno-sanitize-recover=all"
+SOURCE_NAME=bpe_fuzz
+
+set -e
+cd "$(dirname "$0")"
+
+if [ "$1" = "libfuzzer" ]; then
+  shift
+  ${CC:-clang} -O1 -g $DEF_FLAGS_COMPILER -fsanitize=fuzzer,address,undefined -DBPE_FUZZ_LIBFUZZER -o ${SOURCE_NAME}_libfuzzer $SOURCE_NAME.c
+  ./${SOURCE_NAME}_libfuzzer -max_len=300000 "$@"
+else
+  ${CC:-cc} -O1 -g $DEF_FLAGS_COMPILER $DEF_FLAGS_SANITIZER -o $SOURCE_NAME $SOURCE_NAME.c
+  ./$SOURCE_NAME "$@"
+fi
@@ -0,0 +1,280 @@
+/* bpe.h - v0.1 - public domain data structures - nickscha 2025
+
+A C89 standard compliant host tool that trains a dictionary on a sample file (one sample per line)
+and writes it to stdout as a static const header for bpe_static_encode and bpe_static_decode.
+
+USAGE
+    bpe_generate samples.txt my_dictionary 1 > my_dictionary.h
+
+    #include "bpe.h"
+    #include "my_dictionary.h"
+
+    bpe_static_encode(&my_dictionary, text, &text_length);
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+*/
+#include "../bpe.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BPE_GENERATE_MAX_SAMPLES 65536
+#define BPE_GENERATE_MAX_SAMPLE_BYTES (16 * 1024 * 1024)
+#define BPE_GENERATE_MAX_EXPANSION_BYTES (1024 * 1024)
+
+static char sample_data[BPE_GENERATE_MAX_SAMPLE_BYTES];
+static char *samples[BPE_GENERATE_MAX_SAMPLES];
+static unsigned int sample_lengths[BPE_GENERATE_MAX_SAMPLES];
+static char expansion_data[BPE_GENERATE_MAX_EXPANSION_BYTES];
+
+static bpe_dictionary dict;
+static bpe_static_dictionary static_dict;
+
+/* Reads one sample per line (empty lines are skipped), a '\r' before the '\n' is dropped.
+   Returns 0 if the file has more samples or bytes than fit instead of truncating it. */
+static int bpe_generate_read_samples(FILE *file, unsigned int *sample_count)
+{
+  unsigned int count = 0;
+  unsigned int used = 0;
+  int c;
+
+  samples[0] = sample_data;
+  sample_lengths[0] = 0;
+
+  while ((c = fgetc(file)) != EOF)
+  {
+    if (c == '\n')
+    {
+      /* CRLF sample files would otherwise train on a trailing '\r' in every sample */
+      if (sample_lengths[count] > 0 && sample_data[used - 1] == '\r')
+      {
+        used--;
+        sample_lengths[count]--;
+      }
+
+      if (sample_lengths[count] > 0)
+      {
+        /* Appending to the last sample would form pairs across samples */
+        if (count + 1 >= BPE_GENERATE_MAX_SAMPLES)
+        {
+          fprintf(stderr, "[bpe] more than %d samples\n", BPE_GENERATE_MAX_SAMPLES);
+          return (0);
+        }
+
+        count++;
+        samples[count] = sample_data + used;
+        sample_lengths[count] = 0;
+      }
+      continue;
+    }
+
+    if (used >= BPE_GENERATE_MAX_SAMPLE_BYTES)
+    {
+      fprintf(stderr, "[bpe] samples exceed %d bytes\n", BPE_GENERATE_MAX_SAMPLE_BYTES);
+      return (0);
+    }
+
+    sample_data[used++] = (char)c;
+    sample_lengths[count]++;
+  }
+
+  *sample_count = sample_lengths[count] > 0 ? count + 1 : count;
+
+  return (1);
+}
+
+/* Parses a dictionary id in 1..65535, BPE_FRAME_RAW (0) is reserved for raw frames */
+static int bpe_generate_parse_id(const char *text, unsigned short *id)
+{
+  char *end;
+  unsigned long value;
+
+  if (*text < '0' || *text > '9')
+  {
+    return (0);
+  }
+
+  value = strtoul(text, &end, 10);
+
+  if (*end != '\0' || value == BPE_FRAME_RAW || value > 0xFFFF)
+  {
+    return (0);
+  }
+
+  *id = (unsigned short)value;
+
+  return (1);
+}
+
+/* The name is used as C identifier and in the include guard: [A-Za-z_][A-Za-z0-9_]* */
+static int bpe_generate_is_identifier(const char *name)
+{
+  const char *c;
+
+  for (c = name; *c; ++c)
+  {
+    int letter = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || *c == '_';
+    int digit = *c >= '0' && *c <= '9';
+
+    if (!letter && !(digit && c != name))
+    {
+      return (0);
+    }
+  }
+
+  return (c != name);
+}
+
+static void bpe_generate_print_unsigned_array(const char *name, const unsigned int *values, unsigned int count)
+{
+  unsigned int i;
+
+  printf("  /* %s */\n  {", name);
+  for (i = 0; i < count; ++i)
+  {
+    printf("%s%u%s", (i % 16 == 0) ? "\n    " : "", values[i], (i + 1 < count) ? ", " : "");
+  }
+  printf("\n  },\n");
+}
+
+int main(int argc, char **argv)
+{
+  FILE *file;
+  unsigned short id;
+  int read;
+  unsigned int sample_count = 0;
+  unsigned int expansion_size;
+  unsigned int values[BPE_MAX_SYMBOLS];
+  unsigned int i;
+
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: %s <samples.txt> <name> <dictionary id>\n", argv[0]);
+    return (1);
+  }
+
+  if (!bpe_generate_is_identifier(argv[2]))
+  {
+    fprintf(stderr, "[bpe] name must be a C identifier ([A-Za-z_][A-Za-z0-9_]*), got %s\n", argv[2]);
+    return (1);
+  }
+
+  if (!bpe_generate_parse_id(argv[3], &id))
+  {
+    fprintf(stderr, "[bpe] dictionary id must be a number in 1..65535, got %s\n", argv[3]);
+    return (1);
+  }
+
+  file = fopen(argv[1], "rb");
+
+  if (!file)
+  {
+    fprintf(stderr, "[bpe] cannot open %s\n", argv[1]);
+    return (1);
+  }
+
+  read = bpe_generate_read_samples(file, &sample_count);
+  fclose(file);
+
+  if (!read || !bpe_dictionary_train(&dict, id, samples, sample_lengths, sample_count))
+  {
+    return (1);
+  }
+
+  if (!bpe_static_dictionary_build(&dict, &static_dict, expansion_data, BPE_GENERATE_MAX_EXPANSION_BYTES, &expansion_size))
+  {
+    fprintf(stderr, "[bpe] expansions exceed %d bytes\n", BPE_GENERATE_MAX_EXPANSION_BYTES);
+    return (1);
+  }
+
+  fprintf(stderr, "[bpe] samples: %u, merges: %u, expansion bytes: %u\n", sample_count, dict.merge_count, expansion_size);
+
+  printf("/* %s.h - generated by tools/bpe_generate.c from %s, do not edit.\n", argv[2], argv[1]);
+  printf("   Include bpe.h before this file. */\n");
+  printf("#ifndef BPE_DICTIONARY_%s_H\n#define BPE_DICTIONARY_%s_H\n\n", argv[2], argv[2]);
+
+  /* A brace initializer since C89 limits string literals to 509 characters.
+     Bytes above 0x7F are cast as they may not fit a signed char. */
+  printf("static const char %s_expansion_data[%u] = {", argv[2], expansion_size > 0 ? expansion_size : 1);
+  for (i = 0; i < expansion_size || i == 0; ++i)
+  {
+    unsigned char byte = i < expansion_size ? (unsigned char)expansion_data[i] : 0;
+
+    printf("%s%s%s0x%02x", (i > 0) ? "," : "", (i % 16 == 0) ? "\n  " : " ", byte > 0x7F ? "(char)" : "", byte);
+  }
+  printf("\n};\n\n");
+
+  printf("static const bpe_static_dictionary %s = {\n", argv[2]);
+  printf("  %u, /* id */\n", static_dict.id);
+  printf("  %u, /* merge_count */\n", static_dict.merge_count);
+
+  for (i = 0; i < BPE_MAX_SYMBOLS; ++i)
+  {
+    values[i] = static_dict.pair_ranks[i];
+  }
+  bpe_generate_print_unsigned_array("pair_ranks", values, BPE_MAX_SYMBOLS);
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    values[i] = static_dict.rank_pairs[i];
+  }
+  bpe_generate_print_unsigned_array("rank_pairs", values, BPE_NUM_CHARS);
+
+  for (i = 0; i < BPE_NUM_CHARS; ++i)
+  {
+    values[i] = static_dict.rank_symbols[i];
+  }
+  bpe_generate_print_unsigned_array("rank_symbols", values, BPE_NUM_CHARS);
+  bpe_generate_print_unsigned_array("symbol_expansions", static_dict.symbol_expansions, BPE_NUM_CHARS);
+  bpe_generate_print_unsigned_array("symbol_offsets", static_dict.symbol_offsets, BPE_NUM_CHARS);
+
+  printf("  %s_expansion_data\n};\n\n", argv[2]);
+  printf("#endif /* BPE_DICTIONARY_%s_H */\n", argv[2]);
+
+  return (0);
+}
+
+/*
+   ------------------------------------------------------------------------------
+   This software is available under 2 licenses -- choose whichever you prefer.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE A - MIT License
+   Copyright (c) 2025 nickscha
+   Permission is hereby granted, free of charge, to any person obtaining a copy of
+   this software and associated documentation files (the "Software"), to deal in
+   the Software without restriction, including without limitation the rights to
+   use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+   of the Software, and to permit persons to whom the Software is furnished to do
+   so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE B - Public Domain (www.unlicense.org)
+   This is free and unencumbered software released into the public domain.
+   Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+   software, either in source code form or as a compiled binary, for any purpose,
+   commercial or non-commercial, and by any means.
+   In jurisdictions that recognize copyright laws, the author or authors of this
+   software dedicate any and all copyright interest in the software to the public
+   domain. We make this dedication for the benefit of the public at large and to
+   the detriment of our heirs and successors. We intend this dedication to be an
+   overt act of relinquishment in perpetuity of all present and future rights to
+   this software under copyright law.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+   WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+   ------------------------------------------------------------------------------
+*/